@@ -2,6 +2,7 @@
 #define MCSTRUCTURE_BLOCKSTATE_H
 
 #include <cassert>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <variant>
@@ -65,23 +66,9 @@ namespace mcstructure {
             }
 
             template<typename T>
-            T get() const {
+            [[nodiscard]] T get() const {
                 static_assert(std::is_same<T, int>::value || std::is_same<T, bool>::value || std::is_same<T, std::string>::value, "Unsupported block state value type");
-            }
-
-            template<>
-            [[nodiscard]] bool get<bool>() const {
-                return std::get<bool>(p);
-            }
-
-            template<>
-            [[nodiscard]] int get<int>() const {
-                return std::get<int>(p);
-            }
-
-            template<>
-            [[nodiscard]] std::string get<std::string>() const {
-                return std::get<std::string>(p);
+                return std::get<T>(p);
             }
 
         private:
@@ -92,6 +79,7 @@ namespace mcstructure {
 
         template<typename Iterator>
         explicit BlockState(std::string_view name, Iterator first, Iterator last, int version = COMPATIBILITY_VERSION) : m_name(name), m_version(version), m_states(first, last) {
+            m_hash = computeHash();
         }
 
         [[nodiscard]] std::string name() const;
@@ -113,6 +101,10 @@ namespace mcstructure {
         [[nodiscard]] const_reverse_iterator crbegin() const { return m_states.crbegin(); }
         [[nodiscard]] const_reverse_iterator crend() const { return m_states.crend(); }
 
+        // Content hash of the name, version and states. Consistent with operator< only: operator== ignores the
+        // version, so equal blocks of different versions hash differently.
+        [[nodiscard]] uint64_t hash() const;
+
         [[nodiscard]] nbt::tag_compound toNBT() const;
         static BlockState fromNBT(const nbt::tag_compound &data);
 
@@ -144,11 +136,15 @@ namespace mcstructure {
 
     private:
         explicit BlockState(std::string_view name, std::map<std::string, Value> &&states, int version) : m_name(name), m_version(version), m_states(states) {
+            m_hash = computeHash();
         }
 
+        [[nodiscard]] uint64_t computeHash() const;
+
         std::string m_name;
         std::map<std::string, Value> m_states;
         int m_version;
+        uint64_t m_hash;
     };
 
 } // mcstructure
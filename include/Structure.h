@@ -7,6 +7,7 @@
 
 #include <optional>
 #include <functional>
+#include <memory>
 
 namespace mcstructure {
 
@@ -17,6 +18,34 @@ namespace mcstructure {
         };
         using BlockType = std::variant<SpecialBlockValue, BlockState>;
 
+        class Snapshot {
+        public:
+            Size size() const;
+            // Number of sections stored once for both this snapshot and other.
+            int sharedSectionCount(const Snapshot &other) const;
+
+        private:
+            friend class Structure;
+
+            // Blocks of one section in a local palette, run-length encoded. Primary layer first, then secondary.
+            struct Section {
+                std::vector<BlockState> palette;
+                std::vector<std::pair<int, int>> runs;
+                std::map<int, nbt::tag_compound> blockPositionData;
+                std::map<int, uint64_t> blockPositionDataHashes;
+                uint64_t hash;
+            };
+
+            Snapshot(const Size &size, const Coordinate &worldOrigin) : m_size(size), m_worldOrigin(worldOrigin) {
+            }
+
+            Size m_size;
+            Coordinate m_worldOrigin;
+            std::vector<std::shared_ptr<const Section>> m_sections;
+            std::shared_ptr<const std::vector<nbt::tag_compound>> m_entities;
+            uint64_t m_entitiesHash;
+        };
+
         explicit Structure(const Size &size);
         ~Structure() = default;
 
@@ -42,19 +71,58 @@ namespace mcstructure {
         Coordinate worldOrigin() const;
         void setWorldOrigin(const Coordinate &point);
 
+        // Hash of both block layers, block entity data and entities. Independent of palette order and world origin.
+        uint64_t contentHash() const;
+        // Hash of both block layers and block entity data in one section, independent of the section's position.
+        uint64_t sectionHash(const Coordinate &section) const;
+        Size sectionCount() const;
+
         static Structure fromNBT(const nbt::tag_compound &data);
         nbt::tag_compound toNBT() const;
 
+        // Sections left untouched since the last snapshot or restore are shared with it instead of being encoded again.
+        Snapshot snapshot();
+        void restore(const Snapshot &snapshot);
+
+        static const int SECTION_SIZE = 16;
+
     private:
+        uint64_t sectionHash(int sectionIndex) const;
+        std::pair<Coordinate, Coordinate> sectionBounds(int sectionIndex) const;
+        int sectionIndexOf(int pointIndex) const;
+        int localIndexOf(int pointIndex) const;
+        uint64_t voxelHash(int pointIndex, const BlockState &block, bool isSecondaryLayer) const;
+        uint64_t blockEntityHash(int pointIndex, uint64_t dataHash) const;
+        void rehash();
+
+        template<typename Callback>
+        void forEachInSection(int sectionIndex, Callback &&callback) const {
+            auto [from, to] = sectionBounds(sectionIndex);
+            for (int x = from.x; x <= to.x; x++) {
+                for (int y = from.y; y <= to.y; y++) {
+                    int pointIndex = Coordinate(x, y, from.z).toIndex(m_size);
+                    for (int z = from.z; z <= to.z; z++, pointIndex++)
+                        callback(pointIndex);
+                }
+            }
+        }
+
         Size m_size;
 
         std::vector<std::map<BlockState, int>::iterator> m_blockIndices;
         std::vector<std::map<BlockState, int>::iterator> m_secondaryBlockIndices;
         std::map<BlockState, int> m_blockPalette;
 
+        std::vector<uint64_t> m_sectionHashes;
+        // encoded sections of the last snapshot, reset when a section changes
+        std::vector<std::shared_ptr<const Snapshot::Section>> m_sectionSnapshots;
+
         std::vector<nbt::tag_compound> m_entities;
+        uint64_t m_entitiesHash = 0;
+        std::shared_ptr<const std::vector<nbt::tag_compound>> m_entitiesSnapshot;
 
         std::map<int, nbt::tag_compound> m_blockPositionData;
+        std::map<int, uint64_t> m_blockPositionDataHashes;
 
         Coordinate m_worldOrigin;
 
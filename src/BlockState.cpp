@@ -1,6 +1,8 @@
 #include "BlockState.h"
+#include "Hash.h"
 
 #include <algorithm>
+#include <stdexcept>
 #include <utility>
 
 #include <tag_string.h>
@@ -9,6 +11,7 @@ namespace mcstructure {
 
     BlockState::BlockState(std::string_view name, std::initializer_list<std::pair<const std::string, Value>> states,
                            int version) : m_name(name), m_version(version), m_states(states) {
+        m_hash = computeHash();
     }
 
     std::string BlockState::name() const {
@@ -23,6 +26,29 @@ namespace mcstructure {
         return m_states.at(key);
     }
 
+    uint64_t BlockState::hash() const {
+        return m_hash;
+    }
+
+    uint64_t BlockState::computeHash() const {
+        uint64_t h = hash::combine(hash::bytes(m_name), static_cast<uint32_t>(m_version));
+        for (const auto &[key, value]: m_states) {
+            h = hash::combine(h, hash::bytes(key));
+            switch (value.type()) {
+                case BlockState::Value::Boolean:
+                    h = hash::combine(h, hash::combine(Value::Boolean, value.get<bool>()));
+                    break;
+                case BlockState::Value::Integer:
+                    h = hash::combine(h, hash::combine(Value::Integer, static_cast<uint32_t>(value.get<int>())));
+                    break;
+                case BlockState::Value::String:
+                    h = hash::combine(h, hash::bytes(value.get<std::string>(), Value::String));
+                    break;
+            }
+        }
+        return h;
+    }
+
     nbt::tag_compound BlockState::toNBT() const {
         nbt::tag_compound states;
         for (const auto &[key, value]: *this) {
@@ -51,10 +77,10 @@ namespace mcstructure {
 
     BlockState BlockState::fromNBT(const nbt::tag_compound &data) {
         if (!data.has_key("name", nbt::tag_type::String))
-            throw std::exception("Invalid tag: name");
+            throw std::runtime_error("Invalid tag: name");
         std::string name = data.at("name").as<nbt::tag_string>().get();
         if (!data.has_key("states", nbt::tag_type::Compound))
-            throw std::exception("Invalid tag: states");
+            throw std::runtime_error("Invalid tag: states");
         std::map<std::string, Value> states;
         auto nbtStates = data.at("states").as<nbt::tag_compound>();
         for (const auto &[key, nbtValue]: nbtStates) {
@@ -69,11 +95,11 @@ namespace mcstructure {
                     states.insert({key, nbtValue.as<nbt::tag_string>().get()});
                     break;
                 default:
-                    throw std::exception("Invalid tag type in states");
+                    throw std::runtime_error("Invalid tag type in states");
             }
         }
         if (!data.has_key("version", nbt::tag_type::Int))
-            throw std::exception("Invalid tag: version");
+            throw std::runtime_error("Invalid tag: version");
         auto version = int(data.at("version"));
         return BlockState(name, std::move(states), version);
     }
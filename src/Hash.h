@@ -0,0 +1,34 @@
+#ifndef MCSTRUCTURE_HASH_H
+#define MCSTRUCTURE_HASH_H
+
+#include <cstdint>
+#include <string_view>
+
+namespace mcstructure::hash {
+
+    // splitmix64 finalizer
+    inline uint64_t mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    inline uint64_t combine(uint64_t seed, uint64_t value) {
+        return mix(seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+    }
+
+    // FNV-1a
+    inline uint64_t bytes(std::string_view data, uint64_t seed = 0xcbf29ce484222325ULL) {
+        for (unsigned char c: data) {
+            seed ^= c;
+            seed *= 0x100000001b3ULL;
+        }
+        return seed;
+    }
+
+} // mcstructure::hash
+
+#endif //MCSTRUCTURE_HASH_H
@@ -1,17 +1,32 @@
 #include "Structure.h"
+#include "Hash.h"
 
 #include <algorithm>
 #include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
 
 #include <tag_list.h>
 #include <tag_string.h>
+#include <io/stream_writer.h>
 
 namespace mcstructure {
+    static uint64_t hashCompound(const nbt::tag_compound &data) {
+        std::ostringstream stream;
+        nbt::io::stream_writer writer(stream, endian::little);
+        writer.write_tag("", data);
+        return hash::bytes(stream.str());
+    }
+
     Structure::Structure(const Size &size) : m_size(size), m_worldOrigin(0, 0, 0) {
         m_blockIndices.resize(m_size.volume());
         m_secondaryBlockIndices.resize(m_size.volume());
         std::fill(m_blockIndices.begin(), m_blockIndices.end(), m_blockPalette.end());
         std::fill(m_secondaryBlockIndices.begin(), m_secondaryBlockIndices.end(), m_blockPalette.end());
+        auto count = sectionCount();
+        m_sectionHashes.resize(count.volume());
+        m_sectionSnapshots.resize(count.volume());
     }
 
     int Structure::fill(const Coordinate &from, const Coordinate &to, const Structure::BlockType &block,
@@ -62,6 +77,7 @@ namespace mcstructure {
         assert(pointIndex >= 0 && pointIndex < m_size.volume());
         auto &indices = isSecondaryLayer ? m_secondaryBlockIndices : m_blockIndices;
         auto &itRef = indices[pointIndex];
+        uint64_t oldHash = itRef != m_blockPalette.end() ? voxelHash(pointIndex, itRef->first, isSecondaryLayer) : 0;
         if (std::holds_alternative<SpecialBlockValue>(block)) {
             if (itRef != m_blockPalette.end()) {
                 itRef->second--;
@@ -82,6 +98,10 @@ namespace mcstructure {
             itRef = m_blockPalette.insert({std::get<BlockState>(block), 0}).first;
             itRef->second++;
         }
+        uint64_t newHash = itRef != m_blockPalette.end() ? voxelHash(pointIndex, itRef->first, isSecondaryLayer) : 0;
+        auto sectionIndex = sectionIndexOf(pointIndex);
+        m_sectionHashes[sectionIndex] += newHash - oldHash;
+        m_sectionSnapshots[sectionIndex].reset();
         return true;
     }
 
@@ -120,6 +140,16 @@ namespace mcstructure {
         auto [it, isInserted] = m_blockPositionData.insert({pointIndex, data});
         if (!isInserted)
             it->second = data;
+        auto dataHash = hashCompound(data);
+        auto sectionIndex = sectionIndexOf(pointIndex);
+        auto &sectionHashRef = m_sectionHashes[sectionIndex];
+        auto [hashIt, isHashInserted] = m_blockPositionDataHashes.insert({pointIndex, dataHash});
+        if (!isHashInserted) {
+            sectionHashRef -= blockEntityHash(pointIndex, hashIt->second);
+            hashIt->second = dataHash;
+        }
+        sectionHashRef += blockEntityHash(pointIndex, dataHash);
+        m_sectionSnapshots[sectionIndex].reset();
     }
 
     bool Structure::existsBlockPositionData(const Coordinate &point) const {
@@ -131,6 +161,13 @@ namespace mcstructure {
     bool Structure::removeBlockPositionData(const Coordinate &point) {
         auto pointIndex = point.toIndex(m_size);
         assert(pointIndex >= 0 && pointIndex < m_size.volume());
+        auto hashIt = m_blockPositionDataHashes.find(pointIndex);
+        if (hashIt == m_blockPositionDataHashes.end())
+            return false;
+        auto sectionIndex = sectionIndexOf(pointIndex);
+        m_sectionHashes[sectionIndex] -= blockEntityHash(pointIndex, hashIt->second);
+        m_sectionSnapshots[sectionIndex].reset();
+        m_blockPositionDataHashes.erase(hashIt);
         return m_blockPositionData.erase(pointIndex);
     }
 
@@ -146,50 +183,127 @@ namespace mcstructure {
         m_worldOrigin = point;
     }
 
+    uint64_t Structure::contentHash() const {
+        uint64_t h = hash::combine(hash::combine(hash::mix(m_size.x), m_size.y), m_size.z);
+        for (int i = 0; i < m_sectionHashes.size(); i++)
+            h = hash::combine(h, hash::combine(i, sectionHash(i)));
+        return hash::combine(h, m_entitiesHash);
+    }
+
+    uint64_t Structure::sectionHash(const Coordinate &section) const {
+        auto sectionIndex = section.toIndex(sectionCount());
+        assert(sectionIndex >= 0 && sectionIndex < m_sectionHashes.size());
+        return sectionHash(sectionIndex);
+    }
+
+    Size Structure::sectionCount() const {
+        return {
+            (m_size.x + SECTION_SIZE - 1) / SECTION_SIZE,
+            (m_size.y + SECTION_SIZE - 1) / SECTION_SIZE,
+            (m_size.z + SECTION_SIZE - 1) / SECTION_SIZE
+        };
+    }
+
+    std::pair<Coordinate, Coordinate> Structure::sectionBounds(int sectionIndex) const {
+        Coordinate section(sectionIndex, sectionCount());
+        Coordinate from(section.x * SECTION_SIZE, section.y * SECTION_SIZE, section.z * SECTION_SIZE);
+        Coordinate to(std::min(from.x + SECTION_SIZE, m_size.x) - 1,
+                      std::min(from.y + SECTION_SIZE, m_size.y) - 1,
+                      std::min(from.z + SECTION_SIZE, m_size.z) - 1);
+        return {from, to};
+    }
+
+    uint64_t Structure::sectionHash(int sectionIndex) const {
+        // the extent tells a partial edge section apart from a full section that is void past the edge
+        auto [from, to] = sectionBounds(sectionIndex);
+        uint64_t h = hash::combine(hash::combine(hash::mix(to.x - from.x), to.y - from.y), to.z - from.z);
+        return hash::combine(h, m_sectionHashes[sectionIndex]);
+    }
+
+    int Structure::sectionIndexOf(int pointIndex) const {
+        Coordinate point(pointIndex, m_size);
+        return Coordinate(point.x / SECTION_SIZE, point.y / SECTION_SIZE, point.z / SECTION_SIZE).toIndex(sectionCount());
+    }
+
+    int Structure::localIndexOf(int pointIndex) const {
+        // position inside the section, so that equal sections hash equally anywhere
+        Coordinate point(pointIndex, m_size);
+        Size sectionSize(SECTION_SIZE, SECTION_SIZE, SECTION_SIZE);
+        return Coordinate(point.x % SECTION_SIZE, point.y % SECTION_SIZE, point.z % SECTION_SIZE).toIndex(sectionSize);
+    }
+
+    uint64_t Structure::voxelHash(int pointIndex, const BlockState &block, bool isSecondaryLayer) const {
+        return hash::combine(hash::mix(localIndexOf(pointIndex) * 3 + isSecondaryLayer + 1), block.hash());
+    }
+
+    uint64_t Structure::blockEntityHash(int pointIndex, uint64_t dataHash) const {
+        return hash::combine(hash::mix(localIndexOf(pointIndex) * 3 + 3), dataHash);
+    }
+
+    void Structure::rehash() {
+        std::fill(m_sectionHashes.begin(), m_sectionHashes.end(), 0);
+        for (int i = 0; i < m_size.volume(); i++) {
+            if (m_blockIndices[i] != m_blockPalette.end())
+                m_sectionHashes[sectionIndexOf(i)] += voxelHash(i, m_blockIndices[i]->first, false);
+            if (m_secondaryBlockIndices[i] != m_blockPalette.end())
+                m_sectionHashes[sectionIndexOf(i)] += voxelHash(i, m_secondaryBlockIndices[i]->first, true);
+        }
+        m_blockPositionDataHashes.clear();
+        for (const auto &[index, data]: m_blockPositionData) {
+            auto dataHash = hashCompound(data);
+            m_blockPositionDataHashes[index] = dataHash;
+            m_sectionHashes[sectionIndexOf(index)] += blockEntityHash(index, dataHash);
+        }
+        // entities are unordered, so their hashes are summed
+        m_entitiesHash = 0;
+        for (const auto &entity: m_entities)
+            m_entitiesHash += hash::mix(hashCompound(entity));
+    }
+
     Structure Structure::fromNBT(const nbt::tag_compound &data) {
 
         // size
         if (!data.has_key("size", nbt::tag_type::List))
-            throw std::exception("Invalid tag: 'size'");
+            throw std::runtime_error("Invalid tag: 'size'");
         auto nbtSizeList = data.at("size").as<nbt::tag_list>();
         if (nbtSizeList.size() != 3 || nbtSizeList.el_type() != nbt::tag_type::Int)
-            throw std::exception("Invalid value type of list: 'size'");
+            throw std::runtime_error("Invalid value type of list: 'size'");
         Structure structure({int(nbtSizeList[0]), int(nbtSizeList[1]), int(nbtSizeList[2])});
 
         //structure_world_origin
         {
             if (!data.has_key("structure_world_origin", nbt::tag_type::List))
-                throw std::exception("Invalid tag: 'structure_world_origin'");
+                throw std::runtime_error("Invalid tag: 'structure_world_origin'");
             auto nbtStructureWorldOriginList = data.at("structure_world_origin").as<nbt::tag_list>();
             if (nbtStructureWorldOriginList.size() != 3 || nbtStructureWorldOriginList.el_type() != nbt::tag_type::Int)
-                throw std::exception("Invalid value type of list: 'structure_world_origin'");
+                throw std::runtime_error("Invalid value type of list: 'structure_world_origin'");
             structure.setWorldOrigin({int(nbtStructureWorldOriginList[0]), int(nbtStructureWorldOriginList[1]), int(nbtStructureWorldOriginList[2])});
         }
 
         // structure
         if (!data.has_key("structure", nbt::tag_type::Compound))
-            throw std::exception("Invalid tag: 'structure'");
+            throw std::runtime_error("Invalid tag: 'structure'");
         auto nbtStructureComp = data.at("structure").as<nbt::tag_compound>();
 
         // structure.palette
         if (!nbtStructureComp.has_key("palette", nbt::tag_type::Compound))
-            throw std::exception("Invalid tag: 'palette'");
+            throw std::runtime_error("Invalid tag: 'palette'");
         auto nbtPaletteRootComp = nbtStructureComp.at("palette").as<nbt::tag_compound>();
 
         // structure.palette.default
         if (!nbtPaletteRootComp.has_key("default", nbt::tag_type::Compound))
-            throw std::exception("Invalid tag: 'default'");
+            throw std::runtime_error("Invalid tag: 'default'");
         auto nbtPaletteComp = nbtPaletteRootComp.at("default").as<nbt::tag_compound>();
 
         // structure.palette.default.block_palette
         std::vector<decltype(m_blockPalette)::iterator> itList;
         {
             if (!nbtPaletteComp.has_key("block_palette", nbt::tag_type::List))
-                throw std::exception("Invalid tag: 'block_palette'");
+                throw std::runtime_error("Invalid tag: 'block_palette'");
             auto nbtBlockPaletteList = nbtPaletteComp.at("block_palette").as<nbt::tag_list>();
             for (const auto &nbtBlockStateValue: nbtBlockPaletteList) {
                 if (nbtBlockStateValue.get_type() != nbt::tag_type::Compound && nbtBlockStateValue.get_type() != nbt::tag_type::Null)
-                    throw std::exception("Invalid value type of list: 'block_palette'");
+                    throw std::runtime_error("Invalid value type of list: 'block_palette'");
                 auto block = BlockState::fromNBT(nbtBlockStateValue.as<nbt::tag_compound>());
                 itList.push_back(structure.m_blockPalette.insert({block, 0}).first);
             }
@@ -198,15 +312,15 @@ namespace mcstructure {
         // structure.block_indices
         {
             if (!nbtStructureComp.has_key("block_indices", nbt::tag_type::List))
-                throw std::exception("Invalid tag: 'block_indices'");
+                throw std::runtime_error("Invalid tag: 'block_indices'");
             auto nbtBlockIndicesList = nbtStructureComp.at("block_indices").as<nbt::tag_list>();
             if (nbtBlockIndicesList.size() != 2 || nbtBlockIndicesList.el_type() != nbt::tag_type::List)
-                throw std::exception("Invalid value type of list: 'block_indices'");
+                throw std::runtime_error("Invalid value type of list: 'block_indices'");
             {
                 auto nbtPrimaryList = nbtBlockIndicesList[0].as<nbt::tag_list>();
                 if (nbtPrimaryList.size() != structure.m_size.volume() ||
                         (nbtPrimaryList.el_type() != nbt::tag_type::Int && nbtPrimaryList.el_type() != nbt::tag_type::Null))
-                    throw std::exception("Invalid value type of list: 'block_indices[0]'");
+                    throw std::runtime_error("Invalid value type of list: 'block_indices[0]'");
                 for (int i = 0; i < nbtPrimaryList.size(); i++) {
                     auto index = int(nbtPrimaryList[i]);
                     if (index >= 0) {
@@ -221,7 +335,7 @@ namespace mcstructure {
                 auto nbtSecondaryList = nbtBlockIndicesList[1].as<nbt::tag_list>();
                 if (nbtSecondaryList.size() != structure.m_size.volume() ||
                     nbtSecondaryList.el_type() != nbt::tag_type::Int)
-                    throw std::exception("Invalid value type of list: 'block_indices[1]'");
+                    throw std::runtime_error("Invalid value type of list: 'block_indices[1]'");
                 for (int i = 0; i < nbtSecondaryList.size(); i++) {
                     auto index = int(nbtSecondaryList[i]);
                     if (index >= 0) {
@@ -237,10 +351,12 @@ namespace mcstructure {
         // structure.palette.default.block_position_data
         {
             if (!nbtPaletteComp.has_key("block_position_data", nbt::tag_type::Compound))
-                throw std::exception("Invalid tag: 'block_position_data'");
+                throw std::runtime_error("Invalid tag: 'block_position_data'");
             auto nbtBlockPositionDataComp = nbtPaletteComp.at("block_position_data").as<nbt::tag_compound>();
             for (auto &[indexStr, blockData]: nbtBlockPositionDataComp) {
                 int index = std::stoi(indexStr);
+                if (index < 0 || index >= structure.m_size.volume())
+                    throw std::runtime_error("Invalid key of compound: 'block_position_data'");
                 if (blockData.get_type() != nbt::tag_type::Compound)
                     continue;
                 if (!blockData.as<nbt::tag_compound>().has_key("block_entity_data", nbt::tag_type::Compound))
@@ -254,15 +370,17 @@ namespace mcstructure {
         // structure.entities
         {
             if (!nbtStructureComp.has_key("entities", nbt::tag_type::List))
-                throw std::exception("Invalid tag: 'entities'");
+                throw std::runtime_error("Invalid tag: 'entities'");
             auto nbtEntityList = nbtStructureComp.at("entities").as<nbt::tag_list>();
             if (nbtEntityList.el_type() != nbt::tag_type::Compound && nbtEntityList.el_type() != nbt::tag_type::Null)
-                throw std::exception("Invalid value type of list: 'entities'");
+                throw std::runtime_error("Invalid value type of list: 'entities'");
             for (auto &entityValue: nbtEntityList) {
                 structure.m_entities.push_back(entityValue.as<nbt::tag_compound>());
             }
         }
 
+        structure.rehash();
+
         return structure;
     }
 
@@ -318,4 +436,109 @@ namespace mcstructure {
         });
         return nbtRootComp;
     }
+
+    Size Structure::Snapshot::size() const {
+        return m_size;
+    }
+
+    int Structure::Snapshot::sharedSectionCount(const Structure::Snapshot &other) const {
+        if (m_sections.size() != other.m_sections.size())
+            return 0;
+        int count = 0;
+        for (int i = 0; i < m_sections.size(); i++)
+            if (m_sections[i] == other.m_sections[i])
+                count++;
+        return count;
+    }
+
+    Structure::Snapshot Structure::snapshot() {
+        Snapshot snapshot(m_size, m_worldOrigin);
+        std::vector<std::shared_ptr<Snapshot::Section>> encodedSections(m_sectionSnapshots.size());
+        std::unordered_map<const BlockState *, int> localIndices;
+        for (int i = 0; i < m_sectionSnapshots.size(); i++) {
+            if (m_sectionSnapshots[i])
+                continue;
+            auto section = std::make_shared<Snapshot::Section>();
+            section->hash = m_sectionHashes[i];
+            localIndices.clear();
+            decltype(m_blockPalette)::iterator lastIt;
+            for (auto indices: {&m_blockIndices, &m_secondaryBlockIndices}) {
+                forEachInSection(i, [&](int pointIndex) {
+                    auto it = (*indices)[pointIndex];
+                    if (!section->runs.empty() && it == lastIt) {
+                        section->runs.back().second++;
+                        return;
+                    }
+                    lastIt = it;
+                    int localIndex = -1;
+                    if (it != m_blockPalette.end()) {
+                        auto [localIt, isInserted] = localIndices.insert({&it->first, int(section->palette.size())});
+                        if (isInserted)
+                            section->palette.push_back(it->first);
+                        localIndex = localIt->second;
+                    }
+                    section->runs.emplace_back(localIndex, 1);
+                });
+            }
+            section->runs.shrink_to_fit();
+            encodedSections[i] = section;
+        }
+        for (const auto &[index, data]: m_blockPositionData) {
+            auto &section = encodedSections[sectionIndexOf(index)];
+            if (!section)
+                continue;
+            section->blockPositionData.insert({index, data});
+            section->blockPositionDataHashes.insert({index, m_blockPositionDataHashes.at(index)});
+        }
+        for (int i = 0; i < encodedSections.size(); i++)
+            if (encodedSections[i])
+                m_sectionSnapshots[i] = std::move(encodedSections[i]);
+        if (!m_entitiesSnapshot)
+            m_entitiesSnapshot = std::make_shared<const std::vector<nbt::tag_compound>>(m_entities);
+        snapshot.m_sections = m_sectionSnapshots;
+        snapshot.m_entities = m_entitiesSnapshot;
+        snapshot.m_entitiesHash = m_entitiesHash;
+        return snapshot;
+    }
+
+    void Structure::restore(const Structure::Snapshot &snapshot) {
+        m_size = snapshot.m_size;
+        m_worldOrigin = snapshot.m_worldOrigin;
+        m_blockPalette.clear();
+        m_blockIndices.assign(m_size.volume(), m_blockPalette.end());
+        m_secondaryBlockIndices.assign(m_size.volume(), m_blockPalette.end());
+        m_sectionHashes.resize(snapshot.m_sections.size());
+        m_blockPositionData.clear();
+        m_blockPositionDataHashes.clear();
+        std::vector<decltype(m_blockPalette)::iterator> itList;
+        for (int i = 0; i < snapshot.m_sections.size(); i++) {
+            const auto &section = *snapshot.m_sections[i];
+            itList.clear();
+            for (const auto &block: section.palette)
+                itList.push_back(m_blockPalette.insert({block, 0}).first);
+            auto run = section.runs.begin();
+            int remaining = 0;
+            auto it = m_blockPalette.end();
+            for (auto indices: {&m_blockIndices, &m_secondaryBlockIndices}) {
+                forEachInSection(i, [&](int pointIndex) {
+                    if (remaining == 0) {
+                        it = run->first >= 0 ? itList[run->first] : m_blockPalette.end();
+                        remaining = run->second;
+                        run++;
+                    }
+                    remaining--;
+                    (*indices)[pointIndex] = it;
+                    if (it != m_blockPalette.end())
+                        it->second++;
+                });
+            }
+            m_sectionHashes[i] = section.hash;
+            m_blockPositionData.insert(section.blockPositionData.begin(), section.blockPositionData.end());
+            m_blockPositionDataHashes.insert(section.blockPositionDataHashes.begin(), section.blockPositionDataHashes.end());
+        }
+        m_sectionSnapshots = snapshot.m_sections;
+        m_entities = *snapshot.m_entities;
+        m_entitiesHash = snapshot.m_entitiesHash;
+        m_entitiesSnapshot = snapshot.m_entities;
+    }
 } // mcstructure
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <random>
+
+#include <Structure.h>
+#include <io/stream_reader.h>
+
+// Live heap bytes, counted through the global operator new. On Windows the library must be built with
+// MCSTRUCTURE_BUILD_STATIC for its allocations to be counted.
+static std::size_t liveBytes = 0;
+
+void *operator new(std::size_t size) {
+    auto header = static_cast<std::max_align_t *>(std::malloc(size + sizeof(std::max_align_t)));
+    if (!header)
+        throw std::bad_alloc();
+    *reinterpret_cast<std::size_t *>(header) = size;
+    liveBytes += size;
+    return header + 1;
+}
+
+void operator delete(void *p) noexcept {
+    if (!p)
+        return;
+    auto header = static_cast<std::max_align_t *>(p) - 1;
+    liveBytes -= *reinterpret_cast<std::size_t *>(header);
+    std::free(header);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    operator delete(p);
+}
+
+using namespace mcstructure;
+using Clock = std::chrono::steady_clock;
+
+static double elapsedMs(Clock::time_point from) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - from).count();
+}
+
+static void report(const char *name, Structure &st) {
+    std::mt19937 rng(1);
+
+    // what keeping whole copies as undo history costs
+    auto before = liveBytes;
+    auto start = Clock::now();
+    auto copy = std::make_unique<Structure>(st);
+    auto copyMs = elapsedMs(start);
+    auto copyBytes = liveBytes - before;
+
+    before = liveBytes;
+    start = Clock::now();
+    auto snapshot = st.snapshot();
+    auto snapshotMs = elapsedMs(start);
+    auto snapshotBytes = liveBytes - before;
+
+    auto size = st.size();
+    st.setBlock({int(rng() % size.x), int(rng() % size.y), int(rng() % size.z)}, BlockState("minecraft:glass"));
+    before = liveBytes;
+    start = Clock::now();
+    auto editedSnapshot = st.snapshot();
+    auto editedMs = elapsedMs(start);
+    auto editedBytes = liveBytes - before;
+
+    start = Clock::now();
+    st.restore(snapshot);
+    auto restoreMs = elapsedMs(start);
+
+    std::printf("%-28s copy %9.1f KiB %7.2f ms | snapshot %8.1f KiB (%5.1fx) %7.2f ms | after 1 edit %7.1f KiB %6.3f ms | restore %7.2f ms\n",
+                name, copyBytes / 1024.0, copyMs, snapshotBytes / 1024.0, double(copyBytes) / double(snapshotBytes), snapshotMs,
+                editedBytes / 1024.0, editedMs, restoreMs);
+}
+
+int main(int argc, char **argv) {
+    // usage: mcstructure_test_snapshot_benchmark [file.mcstructure...]
+    for (int i = 1; i < argc; i++) {
+        std::ifstream structureFile(argv[i], std::ios_base::in | std::ios_base::binary);
+        if (!structureFile.is_open()) {
+            std::fprintf(stderr, "cannot open %s\n", argv[i]);
+            return 1;
+        }
+        nbt::io::stream_reader reader(structureFile, endian::little);
+        auto st = Structure::fromNBT(*reader.read_compound().second);
+        report(argv[i], st);
+    }
+
+    {
+        Structure st({64, 32, 64});
+        for (int x = 0; x < 64; x++) {
+            for (int z = 0; z < 64; z++) {
+                st.setBlock({x, 0, z}, BlockState("minecraft:stone"));
+                if (x % 16 == 0 || z % 16 == 0)
+                    for (int y = 1; y < 12; y++)
+                        st.setBlock({x, y, z}, BlockState("minecraft:planks", {{"wood_type", std::string(x % 32 ? "oak" : "spruce")}}));
+                if (x % 16 == 8 && z % 16 == 8)
+                    st.setBlockEntityData({x, 1, z}, nbt::tag_compound({{"id", "Chest"}, {"CustomName", std::string(200, 'c')}}));
+            }
+        }
+        report("synthetic village 64x32x64", st);
+    }
+    {
+        Structure st({128, 64, 128});
+        for (int x = 0; x < 128; x++) {
+            for (int z = 0; z < 128; z++) {
+                int height = 30 + int(8 * std::sin(x / 9.0) * std::cos(z / 11.0));
+                for (int y = 0; y < height; y++)
+                    st.setBlock({x, y, z}, BlockState(y < height - 4 ? "minecraft:stone" : y < height - 1 ? "minecraft:dirt" : "minecraft:grass"));
+                for (int y = height; y < 32; y++) {
+                    st.setBlock({x, y, z}, BlockState("minecraft:water", {{"liquid_depth", 0}}));
+                    st.setBlock({x, y, z}, BlockState("minecraft:kelp"), true);
+                }
+            }
+        }
+        report("synthetic terrain 128x64x128", st);
+    }
+    {
+        std::mt19937 rng(42);
+        Structure st({48, 48, 48});
+        for (int i = 0; i < st.size().volume(); i++)
+            st.setBlock(Coordinate(i, st.size()), BlockState("minecraft:wool", {{"color", int(rng() % 64)}}));
+        report("synthetic noise 48x48x48", st);
+    }
+    return 0;
+}
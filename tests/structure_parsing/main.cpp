@@ -1,18 +1,138 @@
 #include <iostream>
 #include <fstream>
+#include <stdexcept>
 
 #include <Structure.h>
 #include <io/stream_reader.h>
 #include <io/stream_writer.h>
 
+static uint64_t recomputedHash(const mcstructure::Structure &st) {
+    return mcstructure::Structure::fromNBT(st.toNBT()).contentHash();
+}
+
+static void testContentHash() {
+    using namespace mcstructure;
+
+    // edge sections are told apart from full sections holding the same blocks
+    Structure small({1, 1, 1});
+    Structure large({16, 16, 16});
+    small.setBlock({0, 0, 0}, BlockState("minecraft:stone"));
+    large.setBlock({0, 0, 0}, BlockState("minecraft:stone"));
+    assert(small.sectionHash({0, 0, 0}) != large.sectionHash({0, 0, 0}));
+
+    // block entity data is part of the section
+    auto sectionHash = large.sectionHash({0, 0, 0});
+    large.setBlockEntityData({0, 0, 0}, nbt::tag_compound({{"id", "Chest"}}));
+    assert(large.sectionHash({0, 0, 0}) != sectionHash);
+    assert(large.contentHash() == recomputedHash(large));
+    large.setBlockEntityData({0, 0, 0}, nbt::tag_compound({{"id", "Barrel"}}));
+    assert(large.contentHash() == recomputedHash(large));
+    large.removeBlockPositionData({0, 0, 0});
+    assert(large.sectionHash({0, 0, 0}) == sectionHash);
+
+    // same content reached through different setBlock orders and palette histories
+    Structure forward({18, 3, 2});
+    Structure backward({18, 3, 2});
+    auto blockAt = [](int i) {
+        return BlockState(i % 3 ? "minecraft:stone" : "minecraft:log", {{"axis", std::string(i % 2 ? "x" : "y")}});
+    };
+    for (int i = 0; i < 18 * 3 * 2; i++)
+        forward.setBlock(Coordinate(i, forward.size()), blockAt(i));
+    for (int i = 0; i < 18 * 3 * 2; i++)
+        backward.setBlock(Coordinate(i, backward.size()), BlockState("minecraft:sand"), true);
+    for (int i = 18 * 3 * 2 - 1; i >= 0; i--) {
+        backward.setBlock(Coordinate(i, backward.size()), BlockState("minecraft:gravel"));
+        backward.setBlock(Coordinate(i, backward.size()), blockAt(i));
+        backward.setBlock(Coordinate(i, backward.size()), Structure::StructureVoid, true);
+    }
+    backward.setBlockEntityData({17, 2, 1}, nbt::tag_compound({{"id", "Chest"}}));
+    backward.removeBlockPositionData({17, 2, 1});
+    assert(!backward.existsInPalette(BlockState("minecraft:sand")));
+    assert(forward.contentHash() == backward.contentHash());
+    assert(forward.sectionHash({1, 0, 0}) == backward.sectionHash({1, 0, 0}));
+    assert(forward.contentHash() == recomputedHash(forward));
+    assert(backward.contentHash() == recomputedHash(backward));
+
+    // block version is part of the hash
+    Structure versioned({1, 1, 1});
+    versioned.setBlock({0, 0, 0}, BlockState("minecraft:stone", {}, BlockState::COMPATIBILITY_VERSION + 1));
+    assert(versioned.contentHash() != small.contentHash());
+}
+
+static void testInvalidBlockPositionData() {
+    using namespace mcstructure;
+
+    for (const char *key: {"8", "5000", "-1"}) {
+        auto data = Structure({2, 2, 2}).toNBT();
+        auto &nbtBlockPositionDataComp = data.at("structure").at("palette").at("default").at("block_position_data").as<nbt::tag_compound>();
+        nbtBlockPositionDataComp[key] = nbt::tag_compound({{"block_entity_data", nbt::tag_compound({{"id", "Chest"}})}});
+        bool isRejected = false;
+        try {
+            Structure::fromNBT(data);
+        } catch (const std::runtime_error &) {
+            isRejected = true;
+        }
+        assert(isRejected);
+    }
+}
+
+static void testSnapshot() {
+    using namespace mcstructure;
+
+    // one voxel wide on y and one voxel past a section boundary on x
+    Structure st({17, 1, 3});
+    for (int x = 0; x < 17; x++) {
+        for (int z = 0; z < 3; z++) {
+            st.setBlock({x, 0, z}, BlockState(x % 3 ? "minecraft:stone" : "minecraft:dirt"));
+            if (z == 1)
+                st.setBlock({x, 0, z}, BlockState("minecraft:water"), true);
+        }
+    }
+    st.setBlockEntityData({16, 0, 2}, nbt::tag_compound({{"id", "Chest"}}));
+    auto expected = st.toNBT();
+    auto snapshot = st.snapshot();
+    assert(st.snapshot().sharedSectionCount(snapshot) == 2);
+
+    st.setBlock({3, 0, 1}, Structure::StructureVoid);
+    st.setBlock({4, 0, 0}, BlockState("minecraft:glass"));
+    auto editedExpected = st.toNBT();
+    auto editedSnapshot = st.snapshot();
+    assert(editedSnapshot.sharedSectionCount(snapshot) == 1);
+
+    st.restore(snapshot);
+    assert(st.toNBT() == expected);
+    assert(st.contentHash() == recomputedHash(st));
+    assert(st.snapshot().sharedSectionCount(snapshot) == 2);
+    st.restore(editedSnapshot);
+    assert(st.toNBT() == editedExpected);
+    assert(st.contentHash() == recomputedHash(st));
+}
+
 int main(int argc, char **argv) {
     std::ifstream structureFile("test.mcstructure", std::ios_base::in | std::ios_base::binary);
     assert(structureFile.is_open());
     nbt::io::stream_reader reader(structureFile, endian::little);
     auto comp = reader.read_compound().second;
     auto st = mcstructure::Structure::fromNBT(*comp);
+    assert(mcstructure::Structure::fromNBT(st.toNBT()).contentHash() == st.contentHash());
     std::cout << std::get<mcstructure::BlockState>(st.getBlock({1, 0, 0})).name() << std::endl;
+    auto expected = st.toNBT();
+    auto snapshot = st.snapshot();
     std::cout << st.fillReplace({0, 0, 0}, {4, 4, 2}, mcstructure::BlockState("minecraft:cobblestone"), mcstructure::BlockState("minecraft:glowstone"));
+    auto editedExpected = st.toNBT();
+    auto editedSnapshot = st.snapshot();
+    st.restore(snapshot);
+    assert(st.toNBT() == expected);
+    assert(st.contentHash() == recomputedHash(st));
+    st.restore(editedSnapshot);
+    assert(st.toNBT() == editedExpected);
+    assert(st.contentHash() == recomputedHash(st));
+    st.setBlock({1, 0, 0}, mcstructure::Structure::StructureVoid);
+    st.setBlock({2, 2, 2}, mcstructure::Structure::StructureVoid, true);
+    assert(st.contentHash() == recomputedHash(st));
+    testContentHash();
+    testInvalidBlockPositionData();
+    testSnapshot();
     std::ofstream outputFile("output.mcstructure", std::ios_base::out | std::ios_base::binary);
     nbt::io::stream_writer writer(outputFile, endian::little);
     writer.write_tag("", st.toNBT());